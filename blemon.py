@@ -2,14 +2,22 @@
 """
 BLE advertisements monitor.
 
+With --store DIR, BTHome readings are decoded and appended to a compact
+binary store instead of being printed (see blestore.py).
+
 Requires: bleak
 """
+import argparse
 import asyncio
 import datetime as dt
 import sys
+import time
+from pathlib import Path
 
 from bleak import BleakScanner
 
+from blestore import BTHOME_UUID, StoreWriter, decode_bthome
+
 enable_color = sys.stdout.isatty()
 
 if enable_color:
@@ -75,18 +83,22 @@ def hexdump(data: bytes) -> str:
     return "".join(parts)
 
 
-if len(sys.argv) == 1:
+def make_mac_filter(macs: list[str]):
+    if not macs:
 
-    def mac_filter(mac: str) -> bool:
-        return mac.startswith("A4:C1:38:")
+        def mac_filter(mac: str) -> bool:
+            return mac.startswith("A4:C1:38:")
 
-else:
+    else:
+        allowed = {mac.strip().upper() for mac in macs}
+
+        def mac_filter(mac: str) -> bool:
+            return mac in allowed
 
-    def mac_filter(mac: str) -> bool:
-        return mac in {arg.strip().upper() for arg in sys.argv[1:]}
+    return mac_filter
 
 
-async def main():
+async def monitor(mac_filter, store) -> None:
     def adv_detected(device, adv):
         mac = device.address.strip().upper()
         if not mac_filter(mac):
@@ -94,6 +106,11 @@ async def main():
 
         # Service data only (uuid -> bytes)
         for uuid, blob in (adv.service_data or {}).items():
+            if store is not None:
+                reading = decode_bthome(blob) if uuid == BTHOME_UUID else None
+                if reading is not None:
+                    store.append(mac, time.time_ns() // 1_000_000, reading)
+                continue
             ts = dt.datetime.now().strftime("%H:%M:%S")
             print(f"[{ts}] [{len(blob)}] {mac} {uuid} {hexdump(blob)}", flush=True)
 
@@ -101,4 +118,27 @@ async def main():
         await asyncio.Event().wait()
 
 
-asyncio.run(main())
+def main(argv: list[str]) -> None:
+    cli = argparse.ArgumentParser(description="BLE advertisements monitor")
+    cli.add_argument(
+        "--store",
+        type=Path,
+        help="Append decoded BTHome readings to this store directory",
+    )
+    cli.add_argument(
+        "macs",
+        nargs="*",
+        help="Devices to monitor (default: all A4:C1:38:* devices)",
+    )
+    args = cli.parse_intermixed_args(argv)
+
+    store = StoreWriter(args.store) if args.store else None
+    try:
+        asyncio.run(monitor(make_mac_filter(args.macs), store))
+    finally:
+        if store is not None:
+            store.close()
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
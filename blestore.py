@@ -0,0 +1,368 @@
+#!/usr/bin/env python
+"""
+Compact time-series store for decoded BTHome readings.
+
+Each device gets its own directory (named after its MAC, without colons)
+holding one file per column. Every column is a flat array of fixed-width,
+little-endian deltas against the previous record:
+
+    ts.u32      timestamp deltas, ms
+    temp.i16    temperature deltas, 0.01°C
+    humi.i16    humidity deltas, 0.01%
+    batt.i8     battery level deltas, %
+    volt.i16    battery voltage deltas, mV
+
+The first record, and any record whose deltas do not all fit their column
+(a gap of more than ~49 days, a wrapped sensor value), is a keyframe: its
+deltas are all zero and its absolute values go to keys.bin instead, as
+(uint32 record index, int64 timestamp, int32 value per value column).
+
+Records are only appended, so a capture can be stopped and resumed at any
+time. If a capture dies mid-append the columns are trimmed back to the
+shortest one on the next open, and keyframes past that point are dropped.
+
+Summary means are time-weighted, since readings are stored when they
+change rather than at a fixed cadence.
+
+The writer only needs the standard library. The reader memory-maps the
+columns and requires: numpy
+
+Usage: blestore.py DIR [--since ISO] [--until ISO] [MAC ...]
+"""
+
+from __future__ import annotations
+
+import argparse
+import datetime as dt
+import struct
+import sys
+from array import array
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Optional
+
+BTHOME_UUID = "0000fcd2-0000-1000-8000-00805f9b34fb"
+
+KEYFRAME = struct.Struct("<Iqiiii")
+KEYFRAME_FILE = "keys.bin"
+
+# The firmware only sends a new packet id when the reading changes, so a
+# stored reading holds until the next one. Capture gaps (monitor not running)
+# look the same, so a single reading is never held longer than this.
+MAX_HOLD_MS = 6 * 3600 * 1000
+
+# name, file, array typecode, numpy dtype, delta range
+COLUMNS = (
+    ("ts", "ts.u32", "I", "<u4", range(0, 1 << 32)),
+    ("temp", "temp.i16", "h", "<i2", range(-(1 << 15), 1 << 15)),
+    ("humi", "humi.i16", "h", "<i2", range(-(1 << 15), 1 << 15)),
+    ("batt", "batt.i8", "b", "<i1", range(-(1 << 7), 1 << 7)),
+    ("volt", "volt.i16", "h", "<i2", range(-(1 << 15), 1 << 15)),
+)
+COLUMN_NAMES = tuple(name for name, *_ in COLUMNS)
+VALUE_COLUMNS = COLUMN_NAMES[1:]
+
+# BTHome v2 object id -> (payload length, field name)
+# Only the objects the firmware sends are known; parsing stops at anything
+# else, since the length of an unknown object cannot be known.
+BTHOME_OBJECTS = {
+    0x00: (1, "packet_id"),
+    0x01: (1, "batt"),
+    0x02: (2, "temp"),
+    0x03: (2, "humi"),
+    0x0C: (2, "volt"),
+    0x2E: (1, None),
+    0x3D: (2, None),
+    0x45: (2, None),
+}
+BTHOME_SIGNED = {0x02, 0x45}
+BTHOME_ENCRYPTED = 0x01
+
+
+@dataclass
+class Reading:
+    packet_id: Optional[int] = None
+    temp: Optional[int] = None
+    humi: Optional[int] = None
+    batt: Optional[int] = None
+    volt: Optional[int] = None
+
+
+def decode_bthome(blob: bytes) -> Optional[Reading]:
+    """Decode a BTHome v2 service data blob. Repeated objects (like the
+    min/max/mean ones from the statistics ADV) are ignored; only the first
+    occurrence of every field is kept."""
+
+    if not blob or blob[0] & BTHOME_ENCRYPTED:
+        return None
+
+    reading = Reading()
+    offset = 1
+    while offset < len(blob):
+        obj_id = blob[offset]
+        if obj_id not in BTHOME_OBJECTS:
+            break
+        length, field = BTHOME_OBJECTS[obj_id]
+        raw = blob[offset + 1 : offset + 1 + length]
+        if len(raw) != length:
+            break
+        offset += 1 + length
+
+        if field is None or getattr(reading, field) is not None:
+            continue
+        value = int.from_bytes(raw, "little", signed=obj_id in BTHOME_SIGNED)
+        setattr(reading, field, value)
+
+    if reading.temp is None or reading.humi is None:
+        return None
+    return reading
+
+
+def device_dir_name(mac: str) -> str:
+    return mac.replace(":", "").upper()
+
+
+def device_mac(dir_name: str) -> str:
+    return ":".join(dir_name[i : i + 2] for i in range(0, len(dir_name), 2))
+
+
+def read_keyframes(path: Path, count: int) -> list[tuple]:
+    """Keyframes of the first `count` records, as (index, ts, values...)."""
+
+    key_path = path / KEYFRAME_FILE
+    raw = key_path.read_bytes() if key_path.exists() else b""
+    raw = raw[: len(raw) - len(raw) % KEYFRAME.size]
+    return [key for key in KEYFRAME.iter_unpack(raw) if key[0] < count]
+
+
+class DeviceWriter:
+    """Appends readings of one device to its column files."""
+
+    def __init__(self, path: Path) -> None:
+        path.mkdir(parents=True, exist_ok=True)
+        self.path = path
+        self.packet_id: Optional[int] = None
+
+        deltas = {}
+        for name, fname, code, *_ in COLUMNS:
+            col = array(code)
+            col_path = path / fname
+            if col_path.exists():
+                raw = col_path.read_bytes()
+                col.frombytes(raw[: len(raw) - len(raw) % col.itemsize])
+            deltas[name] = col
+
+        self.count = min(len(col) for col in deltas.values())
+        keys = read_keyframes(path, self.count)
+        if keys and keys[0][0] != 0:
+            raise ValueError(f"{path}: first record is not a keyframe")
+
+        # Last values: the latest keyframe plus the deltas after it
+        self.last = None
+        if keys:
+            key = keys[-1]
+            self.last = {
+                name: key[1 + i] + sum(deltas[name][key[0] : self.count])
+                for i, name in enumerate(COLUMN_NAMES)
+            }
+
+        self.files = {}
+        for name, fname, code, *_ in COLUMNS:
+            f = open(path / fname, "ab")
+            f.truncate(self.count * array(code).itemsize)
+            self.files[name] = f
+        self.keys_file = open(path / KEYFRAME_FILE, "ab")
+        self.keys_file.truncate(len(keys) * KEYFRAME.size)
+
+    def append(self, ts_ms: int, reading: Reading) -> bool:
+        """Store a reading; returns False for a repeated advertisement."""
+
+        # Statistics ADVs carry the current temperature and humidity but no
+        # battery data; until a full reading has been stored there is nothing
+        # to fill the gap with, so skip them rather than store zeros
+        if self.last is None and any(getattr(reading, name) is None for name in VALUE_COLUMNS):
+            return False
+
+        if reading.packet_id is not None:
+            if reading.packet_id == self.packet_id:
+                return False
+            self.packet_id = reading.packet_id
+
+        last = self.last or {}
+        values = {"ts": max(ts_ms, last.get("ts", ts_ms))}
+        for name in VALUE_COLUMNS:
+            value = getattr(reading, name)
+            values[name] = last[name] if value is None else value
+
+        # Every column is checked before anything is written, so a record is
+        # either stored whole as deltas, or whole as a keyframe
+        deltas = {name: values[name] - last.get(name, values[name]) for name in COLUMN_NAMES}
+        if self.last is None or any(deltas[name] not in fits for name, *_, fits in COLUMNS):
+            deltas = dict.fromkeys(COLUMN_NAMES, 0)
+            self.keys_file.write(KEYFRAME.pack(self.count, *(values[name] for name in COLUMN_NAMES)))
+            self.keys_file.flush()
+
+        for name, _, code, *_ in COLUMNS:
+            self.files[name].write(array(code, [deltas[name]]).tobytes())
+        for f in self.files.values():
+            f.flush()
+        self.last = values
+        self.count += 1
+        return True
+
+    def close(self) -> None:
+        for f in self.files.values():
+            f.close()
+        self.keys_file.close()
+
+
+class StoreWriter:
+    def __init__(self, path: Path) -> None:
+        self.path = path
+        self.devices: dict[str, DeviceWriter] = {}
+
+    def append(self, mac: str, ts_ms: int, reading: Reading) -> bool:
+        if mac not in self.devices:
+            self.devices[mac] = DeviceWriter(self.path / device_dir_name(mac))
+        return self.devices[mac].append(ts_ms, reading)
+
+    def close(self) -> None:
+        for device in self.devices.values():
+            device.close()
+
+
+class DeviceReader:
+    """Memory-mapped view of one device. Columns are decoded (cumulative sum
+    of the deltas) on first use."""
+
+    def __init__(self, path: Path) -> None:
+        import numpy as np
+
+        self.np = np
+        self.path = path
+        self.mac = device_mac(path.name)
+
+        maps = {}
+        for name, fname, _, dtype, _ in COLUMNS:
+            col_path = path / fname
+            size = col_path.stat().st_size if col_path.exists() else 0
+            count = size // np.dtype(dtype).itemsize
+            if count:
+                maps[name] = np.memmap(col_path, dtype=dtype, mode="r", shape=(count,))
+            else:
+                maps[name] = np.zeros(0, dtype=dtype)
+
+        self.count = min(len(m) for m in maps.values())
+        self.keys = read_keyframes(path, self.count)
+        self.maps = maps
+        self.cache = {}
+
+    def column(self, name: str):
+        if name not in self.cache:
+            deltas = self.maps[name][: self.count]
+            values = self.np.cumsum(deltas, dtype=self.np.int64)
+            # Keyframe deltas are zero; shift every run of records starting
+            # at a keyframe so it starts at the keyframe's absolute value
+            if self.keys:
+                np = self.np
+                col = 1 + COLUMN_NAMES.index(name)
+                index = np.array([key[0] for key in self.keys], dtype=np.int64)
+                start = np.array([key[col] for key in self.keys], dtype=np.int64)
+                lengths = np.diff(np.append(index, len(values)))
+                values += np.repeat(start - values[index], lengths)
+            self.cache[name] = values
+        return self.cache[name]
+
+    def range(self, since_ms: Optional[int] = None, until_ms: Optional[int] = None) -> slice:
+        ts = self.column("ts")
+        start = 0 if since_ms is None else int(self.np.searchsorted(ts, since_ms, "left"))
+        stop = len(ts) if until_ms is None else int(self.np.searchsorted(ts, until_ms, "right"))
+        return slice(start, stop)
+
+    def query(self, since_ms: Optional[int] = None, until_ms: Optional[int] = None) -> dict:
+        sel = self.range(since_ms, until_ms)
+        return {name: self.column(name)[sel] for name in COLUMN_NAMES}
+
+    def summary(self, since_ms: Optional[int] = None, until_ms: Optional[int] = None) -> dict:
+        np = self.np
+        all_ts = self.column("ts")
+        sel = self.range(since_ms, until_ms)
+
+        # The reading in effect at `since` was stored before it; seed the
+        # range with it, unless it had already run out its hold time
+        start = sel.start
+        if since_ms is not None and start > 0 and since_ms - all_ts[start - 1] < MAX_HOLD_MS:
+            start -= 1
+        sel = slice(start, sel.stop)
+
+        result = {"count": sel.stop - sel.start}
+        if not result["count"]:
+            return result
+        ts = all_ts[sel]
+
+        # Means are time-weighted: each reading counts from when it was
+        # stored (or `since`) until the next reading, the end of the range or
+        # MAX_HOLD_MS, whichever is first
+        end = int(ts[-1]) if until_ms is None else until_ms
+        if sel.stop < len(all_ts):
+            end = min(end, int(all_ts[sel.stop]))
+        starts = ts if since_ms is None else np.maximum(ts, since_ms)
+        ends = np.minimum(np.append(ts[1:], max(end, int(ts[-1]))), ts + MAX_HOLD_MS)
+        hold = np.maximum(ends - starts, 0)
+        weights = hold if hold.sum() else None
+        result["first"], result["last"] = int(starts[0]), int(starts[-1])
+
+        for name in VALUE_COLUMNS:
+            values = self.column(name)[sel]
+            mean = float(np.average(values, weights=weights))
+            result[name] = (int(values.min()), int(values.max()), mean)
+        return result
+
+class StoreReader:
+    def __init__(self, path: Path) -> None:
+        self.path = path
+
+    def devices(self) -> list[DeviceReader]:
+        return [
+            DeviceReader(p)
+            for p in sorted(self.path.iterdir())
+            if p.is_dir() and (p / KEYFRAME_FILE).exists()
+        ]
+
+
+def parse_time(value: str) -> int:
+    return int(dt.datetime.fromisoformat(value).timestamp() * 1000)
+
+
+def fmt_time(ts_ms: int) -> str:
+    return dt.datetime.fromtimestamp(ts_ms / 1000).strftime("%Y-%m-%d %H:%M:%S")
+
+
+def main(argv: list[str]) -> None:
+    SCALE = {"temp": 100, "humi": 100, "batt": 1, "volt": 1000}
+    cli = argparse.ArgumentParser(description="Summarize a BLE monitor store")
+    cli.add_argument("store", type=Path, help="Store directory")
+    cli.add_argument("--since", type=parse_time, help="Range start (ISO 8601)")
+    cli.add_argument("--until", type=parse_time, help="Range end (ISO 8601)")
+    cli.add_argument("macs", nargs="*", help="Only these devices")
+    args = cli.parse_intermixed_args(argv)
+
+    macs = {mac.strip().upper() for mac in args.macs}
+    for device in StoreReader(args.store).devices():
+        if macs and device.mac not in macs:
+            continue
+        summary = device.summary(args.since, args.until)
+        if not summary["count"]:
+            continue
+        print(
+            f"{device.mac} {summary['count']} samples "
+            f"{fmt_time(summary['first'])} .. {fmt_time(summary['last'])}"
+        )
+        for name in VALUE_COLUMNS:
+            lo, hi, mean = summary[name]
+            scale = SCALE[name]
+            print(f"  {name}: min {lo / scale:g} max {hi / scale:g} mean {mean / scale:.2f}")
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -4,6 +4,10 @@ Telink flasher for Mi thermoemeter firmware.
 
 Requires: pyserial
 
+With --calibrate, the flasher probes for the fastest UART baud rate and SWS
+clock divider that survive a write/read-back test, and caches the result per
+adapter. This needs the RX pin wired to the SWS pad (P14) as well.
+
 Permission is hereby granted, free of charge, to any person obtaining
 a copy of this software and associated documentation files (the "Software"),
 to deal in the Software without restriction, including without limitation the
@@ -22,12 +26,16 @@ from __future__ import annotations
 
 import argparse
 import functools
+import json
+import os
 import struct
 import sys
 import time
 from pathlib import Path
+from typing import Optional
 
 import serial
+import serial.tools.list_ports
 
 
 def sleep_ms(ms: int) -> None:
@@ -56,6 +64,16 @@ SWS_MASK_FIFO_DISABLE = 0b0000_0000
 SWS_CPU_STATE = 0x0602
 SWS_CPU_STOP_CMD = 0x05
 
+SWS_CLK_DIV = 55
+SWS_READ_FLAG = 0x80
+
+FLASH_CHUNK_SIZE = 256
+
+# SRAM scratch area for the link test; the CPU is halted and the firmware is
+# about to be replaced, so its contents do not matter
+SWS_SCRATCH_ADDR = 0x04C000
+SWS_TEST_PATTERN = bytes([0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x3C, 0xC3])
+
 TLK_REG_PWDNEN = 0x6F
 TLK_REG_PWDNEN_RST_ALL = 0b0010_0000
 
@@ -68,22 +86,29 @@ class SwsUart(serial.Serial):
 
     MASKS = (0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01)
 
+    # Host releases the line for one bit slot; the chip stretches the low
+    # part of the slot for a 1 bit when answering a read
+    SWS_BIT_READ = 0xFF
+
+    START_CMD = 0x5A
+    STOP_CMD = 0xFF
+
     @classmethod
-    def sws_encode_data(cls, addr: int, data: bytes) -> bytes:
+    def sws_encode_data(cls, addr: int, data: bytes, flags: int = 0x00) -> bytes:
         """Encode SWS data: each byte -> 10-bit SWS word -> 10 UART bytes.
 
         This models the UART TX waveform into something that SWS recognizes.
         """
 
-        START_CMD = 0x5A
-        STOP_CMD = 0xFF
+        START_CMD = cls.START_CMD
+        STOP_CMD = cls.STOP_CMD
 
         header = bytes(
             [
                 (addr >> 16) & 0xFF,
                 (addr >> 8) & 0xFF,
                 addr & 0xFF,
-                0x00,
+                flags,
             ]
         )
 
@@ -114,11 +139,59 @@ class SwsUart(serial.Serial):
             + [cls.SWS_BIT_LOW]
         )
 
+    @classmethod
+    def sws_decode_byte(cls, slots: bytes) -> int:
+        """Decode 8 read slots (as seen on RX) into a byte, MSB first.
+
+        A slot with most of its bits low was stretched by the chip -> 1.
+        """
+
+        byte = 0
+        for slot in slots:
+            low_bits = 8 - bin(slot).count("1")
+            byte = (byte << 1) | (low_bits >= 4)
+        return byte
+
     def write_sws(self, address: int, data: bytes) -> None:
         to_write = self.sws_encode_data(address, data)
         self.write(to_write)
         self.flush()
 
+    def has_echo(self) -> bool:
+        """Whether RX is wired to the SWS line (i.e. TX is echoed back)."""
+
+        to_write = self.sws_encode_data(SWS_CPU_STATE, bytes([SWS_CPU_STOP_CMD]))
+        self.reset_input_buffer()
+        self.write(to_write)
+        self.flush()
+        return self.read(len(to_write)) == to_write
+
+    def read_sws(self, address: int, length: int) -> Optional[bytes]:
+        """Read `length` bytes. Requires RX to be wired to the SWS line too,
+        so everything sent is echoed back; returns None on a short read."""
+
+        # Start command + address + read flag; no data, no stop command
+        header = self.sws_encode_data(address, b"", SWS_READ_FLAG)[:-10]
+        slots = bytes([SwsUart.SWS_BIT_LOW] + [SwsUart.SWS_BIT_READ] * 9)
+        to_write = header + slots * length
+
+        self.reset_input_buffer()
+        self.write(to_write)
+        self.flush()
+        echo = self.read(len(to_write))
+
+        stop = self.sws_encode_byte(self.STOP_CMD)
+        self.write(bytes([self.SWS_BIT_HIGH]) + stop[1:])
+        self.flush()
+
+        if len(echo) != len(to_write):
+            return None
+
+        data = bytearray()
+        for offset in range(len(header), len(echo), 10):
+            data.append(self.sws_decode_byte(echo[offset + 1 : offset + 9]))
+        return bytes(data)
+
 
 class TelinkSws:
     def __init__(self, sws: SwsUart) -> None:
@@ -178,30 +251,179 @@ class TelinkSws:
     def chip_reset(self) -> None:
         self.sws.write_sws(TLK_REG_PWDNEN, bytes([TLK_REG_PWDNEN_RST_ALL]))
 
-    def force_cpu_state(self, tim_ms: int) -> None:
+    def force_cpu_state(self, tim_ms: int, probe: bool = False) -> bool:
+        """Keep halting the CPU for `tim_ms`. With `probe`, stop as soon as
+        the CPU reads back as halted; only pass it when the echo is known to
+        work, or every read sits out the serial timeout and starves the halt
+        loop. Returns whether the halt was confirmed."""
+
+        PROBE_INTERVAL_MS = 50
+
         self.chip_reset()
 
         end_t = time.monotonic() + (tim_ms / 1000.0)
+        probe_t = time.monotonic()
         while time.monotonic() < end_t:
             self.sws.write_sws(SWS_CPU_STATE, bytes([SWS_CPU_STOP_CMD]))
             sleep_ms(1)
-
-    def set_sws_clk_speed(self):
-        SWS_CLK_DIV = 55
-        self.sws.write_sws(SWS_REG_SWIRE_CLOCK_DIV, bytes([SWS_CLK_DIV]))
+            if probe and time.monotonic() >= probe_t:
+                self.set_sws_clk_speed()
+                if self.cpu_halted():
+                    return True
+                probe_t = time.monotonic() + PROBE_INTERVAL_MS / 1000.0
+        return False
+
+    def cpu_halted(self) -> bool:
+        # SWS works on a running core too; only the CPU state proves the halt.
+        # Anything else just means the full activation window is used
+        state = self.sws.read_sws(SWS_CPU_STATE, 1)
+        return state == bytes([SWS_CPU_STOP_CMD])
+
+    def set_sws_clk_speed(self, clk_div: int = SWS_CLK_DIV):
+        self.sws.write_sws(SWS_REG_SWIRE_CLOCK_DIV, bytes([clk_div]))
         self.sws.write_sws(SWS_CPU_STATE, bytes([SWS_CPU_STOP_CMD]))
 
-
-def flash_fw(port: SwsUart, firmware: bytes, activate_ms: int) -> None:
-    CHUNK_SIZE = 256
+    def check_link(self) -> bool:
+        """Write/read-back test, as long as one flash write chunk."""
+
+        pattern = (SWS_TEST_PATTERN * FLASH_CHUNK_SIZE)[:FLASH_CHUNK_SIZE]
+        self.sws.write_sws(SWS_SCRATCH_ADDR, pattern)
+        data = self.sws.read_sws(SWS_SCRATCH_ADDR, len(pattern))
+        return data == pattern
+
+    def set_link_speed(self, baud: int, clk_div: int) -> bool:
+        """Switch the SWS divider and the UART baud rate; check the result."""
+
+        self.set_sws_clk_speed(clk_div)
+        self.sws.baudrate = baud
+        sleep_ms(1)
+        return self.check_link()
+
+    def calibrate(self) -> tuple[int, int]:
+        """Find the fastest baud rate / SWS divider pair that passes the link
+        test. Must start from a working link at the current baud rate and
+        SWS_CLK_DIV; ends with the link set to the returned pair.
+
+        The divider returned for a baud rate is the middle of the range that
+        passed, not its lower edge, to leave some margin."""
+
+        BAUD_RATES = (3000000, 2000000, 1500000, 1000000, 921600)
+        RETRIES = 3
+        MAX_CLK_DIV = 0x7F
+
+        base_baud = self.sws.baudrate
+        best = (base_baud, SWS_CLK_DIV)
+
+        def passes(baud: int, clk_div: int) -> bool:
+            if all(self.set_link_speed(baud, clk_div) for _ in range(RETRIES)):
+                return True
+            # Every candidate starts from the last verified link
+            self.restore_link(*best)
+            return False
+
+        for baud in sorted(b for b in BAUD_RATES if b > base_baud):
+            # Divider scales inversely with the bit rate; find a passing one
+            # near the estimate, then widen the range both ways until it fails
+            estimate = round(SWS_CLK_DIV * base_baud / baud)
+            near = (estimate, estimate + 1, estimate - 1, estimate + 2, estimate - 2)
+            start = next((d for d in near if 2 <= d <= MAX_CLK_DIV and passes(baud, d)), None)
+            if start is None:
+                break
+            low = high = start
+            while low > 2 and passes(baud, low - 1):
+                low -= 1
+            while high < MAX_CLK_DIV and passes(baud, high + 1):
+                high += 1
+            clk_div = (low + high + 1) // 2
+            print(f"  {baud} baud, SWS clk div {low}..{high}: using {clk_div}")
+            best = (baud, clk_div)
+
+        self.restore_link(*best)
+        return best
+
+    def restore_link(self, baud: int, clk_div: int) -> None:
+        self.sws.baudrate = baud
+        if not self.set_link_speed(baud, clk_div):
+            raise RuntimeError("Lost the SWS link during calibration")
+
+
+def adapter_id(port: str) -> str:
+    """Stable identity of a USB UART adapter, falling back to the port name."""
+
+    for info in serial.tools.list_ports.comports():
+        if info.device == port and info.vid is not None:
+            return f"{info.vid:04X}:{info.pid:04X}:{info.serial_number or ''}"
+    return port
+
+
+def link_cache_path() -> Path:
+    cache_home = os.environ.get("XDG_CACHE_HOME") or Path.home() / ".cache"
+    return Path(cache_home) / "mrm_mi_flash.json"
+
+
+def load_link_cache() -> dict:
+    try:
+        return json.loads(link_cache_path().read_text())
+    except (OSError, ValueError):
+        return {}
+
+
+def save_link_cache(adapter: str, link: Optional[tuple[int, int]]) -> None:
+    cache = load_link_cache()
+    if link is None:
+        cache.pop(adapter, None)
+    else:
+        cache[adapter] = {"baud": link[0], "clk_div": link[1]}
+    path = link_cache_path()
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(json.dumps(cache, indent=2))
+
+
+def flash_fw(
+    port: SwsUart,
+    firmware: bytes,
+    activate_ms: int,
+    link: Optional[tuple[int, int]] = None,
+    calibrate: bool = False,
+) -> Optional[tuple[int, int]]:
+    """Flash the firmware. `link` is a (baud, SWS clk div) pair to switch to
+    after activation. With `calibrate`, the fastest link is probed instead.
+    Returns the link that was used, or None for the default one.
+
+    Whenever read-back is known to work (calibrating, or a link calibrated
+    earlier), activation stops as soon as the CPU reads back as halted
+    instead of running for the whole `activate_ms`. Calibration and cached
+    links rely on the link test alone, not on that halt check. A cached link
+    that fails the link test is replaced by the default one."""
 
     flasher = TelinkSws(port)
+    base_baud = port.baudrate
 
     time_start = time.monotonic()
+    # Checked before the reset: without RX wired up this sits out the serial
+    # timeout, which must not eat into the activation window
+    echo = (calibrate or link is not None) and port.has_echo()
     print("Bombarding chip with CPU halt")
-    flasher.force_cpu_state(activate_ms)
+    if flasher.force_cpu_state(activate_ms, probe=echo):
+        print("CPU halt confirmed")
     print("Setting SWS clk speed")
     flasher.set_sws_clk_speed()
+    linked = echo and flasher.check_link()
+    if calibrate:
+        if not linked:
+            print("SWS link test failed (is RX wired to the SWS pad?)")
+            sys.exit(3)
+        print("Calibrating link speed")
+        link = flasher.calibrate()
+    elif link is not None:
+        if linked and flasher.set_link_speed(*link):
+            print("Cached link speed verified")
+        else:
+            print("Cached link speed could not be verified, using the default")
+            port.baudrate = base_baud
+            flasher.set_sws_clk_speed()
+            link = None
+    print(f"Link: {port.baudrate} baud, SWS clk div {link[1] if link else SWS_CLK_DIV}")
     print("Waking up flash")
     flasher.flash_wake_up()
 
@@ -212,12 +434,12 @@ def flash_fw(port: SwsUart, firmware: bytes, activate_ms: int) -> None:
 
     print("Flashing!")
     print(f"Writing {len(firmware)} bytes into flash")
-    for offset in range(0, len(firmware), CHUNK_SIZE):
+    for offset in range(0, len(firmware), FLASH_CHUNK_SIZE):
         if (offset % 0x1000) == 0:
             print(f"Erasing sector: 0x{offset:06X}")
             flasher.sector_erase(offset)
 
-        chunk = firmware[offset : offset + CHUNK_SIZE]
+        chunk = firmware[offset : offset + FLASH_CHUNK_SIZE]
         print(f"Writing {len(chunk)} bytes at 0x{offset:06X}")
         flasher.bulk_write_flash(offset, chunk)
 
@@ -226,6 +448,7 @@ def flash_fw(port: SwsUart, firmware: bytes, activate_ms: int) -> None:
 
     time_done = time.monotonic() - time_start
     print(f"Done in {time_done:.3f} sec.")
+    return link
 
 
 def check_magic(firmware: bytes):
@@ -252,7 +475,17 @@ def main(argv: list[str]) -> None:
         "--baud",
         type=int,
         default=DEFAULT_BAUD,
-        help=f"Baud rate (default: {DEFAULT_BAUD})",
+        help=f"Baud rate used to activate the chip (default: {DEFAULT_BAUD})",
+    )
+    cli.add_argument(
+        "--calibrate",
+        action="store_true",
+        help="Probe and cache the fastest link speed (RX must be wired to SWS)",
+    )
+    cli.add_argument(
+        "--no-cache",
+        action="store_true",
+        help="Ignore the cached link speed for this adapter",
     )
     cli.add_argument(
         "--activate-ms",
@@ -270,13 +503,22 @@ def main(argv: list[str]) -> None:
     args = cli.parse_args(argv)
 
     print(f"Using port: {args.port}")
-    sc = SwsUart(port=args.port, baudrate=args.baud)
+    sc = SwsUart(port=args.port, baudrate=args.baud, timeout=0.1)
+
+    adapter = adapter_id(args.port)
+    cached = None
+    entry = load_link_cache().get(adapter)
+    if entry and not (args.no_cache or args.calibrate):
+        cached = (entry["baud"], entry["clk_div"])
+        print(f"Using cached link speed for {adapter}")
 
     try:
         firmware = args.file.read_bytes()
         print(f"Loaded firmware from {args.file} ({len(firmware)} bytes)")
         check_magic(firmware)
-        flash_fw(sc, firmware, args.activate_ms)
+        link = flash_fw(sc, firmware, args.activate_ms, cached, args.calibrate)
+        if args.calibrate or link != cached:
+            save_link_cache(adapter, link)
 
     finally:
         sc.close()
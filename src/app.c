@@ -9,6 +9,8 @@
 #include "lcd.h"
 #include "sensor.h"
 #include "settings.h"
+#include "stats.h"
+#include "sysclk.h"
 
 RAM uint32_t last_delay = 0xFFFF0000, last_battery_delay = 0xFFFF0000;
 int16_t temp = 0;
@@ -19,14 +21,24 @@ RAM uint16_t last_humi;
 RAM uint8_t battery_level;
 RAM uint16_t battery_mv;
 RAM bool show_batt_or_humi;
+RAM uint8_t stats_adv_count;
+RAM uint8_t stats_adv_window;
+RAM bool stats_adv_active;
 
 RAM int16_t comfort_x[] = {2000, 2560, 2700, 2500, 2050, 1700, 1600, 1750};
 RAM uint16_t comfort_y[] = {2000, 1980, 3200, 6000, 8200, 8600, 7700, 3800};
 
+int16_t adv_temp(int16_t temp){
+    if (CONF_ADV_TEMP_C_OR_F)
+        return ((((temp*10)/5)*9)+3200)/10;
+    return temp;
+}
+
 void user_init_normal(void){
     random_generator_init();
     init_ble();
     init_sensor();
+    init_stats();
     init_lcd();
     show_atc_mac();
     show_fw_version();
@@ -42,7 +54,9 @@ _attribute_ram_code_ void user_init_deepRetn(void){
 }
 
 void main_loop(){
-    if ((clock_time()-last_delay) > 5000*CLOCK_SYS_CLOCK_1MS){
+    tick_stats();
+    if ((clock_time()-last_delay) > MAIN_LOOP_INTERVAL){
+        set_housekeeping_clock();
 
         if ((clock_time()-last_battery_delay) > 5*60000*CLOCK_SYS_CLOCK_1MS){
             battery_mv = get_battery_mv();
@@ -55,15 +69,32 @@ void main_loop(){
             temp += CONF_TEMP_OFFSET;
             humi += CONF_HUMI_OFFSET;
             meas_count = 0;
+            update_stats(temp, humi);
+
+            // Windows take turns; one that has not completed yet is skipped
+            stats_t stats;
+            bool stats_ready = false;
+            if (CONF_STATS_ADV_MEASUREMENTS
+                    && ++stats_adv_count >= CONF_STATS_ADV_MEASUREMENTS){
+                for (uint8_t i = 0; i < STATS_WINDOWS && !stats_ready; i++){
+                    stats_adv_window = (stats_adv_window + 1) % STATS_WINDOWS;
+                    stats_ready = get_stats(stats_adv_window, &stats);
+                }
+            }
 
-            if (temp != last_temp || humi != last_humi){
-                if (CONF_ADV_TEMP_C_OR_F)
-                    set_adv_data(((((temp*10)/5)*9)+3200)/10, humi, battery_level, battery_mv);
-                else
-                    set_adv_data(temp, humi, battery_level, battery_mv);
-                last_temp = temp;
-                last_humi = humi;
+            if (stats_ready){
+                stats.temp_min = adv_temp(stats.temp_min);
+                stats.temp_max = adv_temp(stats.temp_max);
+                stats.temp_mean = adv_temp(stats.temp_mean);
+                set_stats_adv_data(adv_temp(temp), humi, stats_adv_window, &stats);
+                stats_adv_count = 0;
+                stats_adv_active = true;
+            }else if (temp != last_temp || humi != last_humi || stats_adv_active){
+                set_adv_data(adv_temp(temp), humi, battery_level, battery_mv);
+                stats_adv_active = false;
             }
+            last_temp = temp;
+            last_humi = humi;
         }
         meas_count++;
 
@@ -88,6 +119,7 @@ void main_loop(){
         show_batt_or_humi = !show_batt_or_humi;
 
         update_lcd();
+        set_radio_clock();
         last_delay = clock_time();
     }
     blt_sdk_main_loop();
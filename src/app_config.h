@@ -2,6 +2,20 @@
 
 #define CLOCK_SYS_CLOCK_HZ 24000000
 
+// System clock used while main_loop() does sensor, LCD and battery work. The
+// BLE stack gets CLOCK_SYS_CLOCK_HZ back before blt_sdk_main_loop() runs.
+// Equal to CLOCK_SYS_CLOCK_HZ disables clock scaling. 12000000 runs the
+// housekeeping slower; its effect on average current has not been measured
+// yet, so scaling is off by default.
+#define CLOCK_HOUSEKEEPING_HZ CLOCK_SYS_CLOCK_HZ
+
+// Minimum time between two passes of main_loop() work, in clock_time()
+// ticks. clock_time() counts the 16MHz system timer, not the system clock, so
+// with CLOCK_SYS_CLOCK_1MS at 24MHz this is 7.5s. main_loop() itself only
+// runs when the chip wakes up for an advertising event, so the actual period
+// is rounded up to a whole number of ADV intervals.
+#define MAIN_LOOP_INTERVAL (5000*CLOCK_SYS_CLOCK_1MS)
+
 #define RAM _attribute_data_retention_ // short version, this is needed to keep the values in ram after sleep
 
 enum{
@@ -9,6 +9,7 @@
 
 #include "ble.h"
 #include "settings.h"
+#include "stats.h"
 
 // BTHome v2 (unencrypted) ADV
 // Includes Flags (recommended) + Service Data (UUID 0xFCD2)
@@ -30,6 +31,37 @@ RAM uint8_t advertising_data_BTHome[] = {
     0x0C, 0x00, 0x00,  // 0x0C voltage (0.001V, little-endian) -> battery_mv in mV
 };
 
+// BTHome v2 statistics ADV, sent periodically instead of the regular one
+// Carries the current reading and the min/max/mean of the last completed
+// window of one of the statistics windows (see stats.c). Repeated objects
+// keep their order:
+// 0x00 packet id (uint8)
+// 0x02 temperature (sint16, 0.01°C)  - current
+// 0x03 humidity (uint16, 0.01%)      - current
+// 0x2E humidity (uint8, 1%)          - min, max, mean
+// 0x3D count (uint16)                - window sequence number << 1 | window
+// 0x45 temperature (sint16, 0.1°C)   - min, max, mean
+// The sequence number goes up by one per completed window, so gateways can
+// tell a repeated window from a new one and notice missed windows; the low
+// bit says which window (0 - short, 1 - long) the packet describes.
+// The Flags AD is left out to fit the 31 byte payload; it is optional for a
+// non-connectable, non-discoverable advertiser. Battery data only goes out in
+// the regular ADV.
+RAM uint8_t advertising_data_BTHome_stats[] = {
+    0x1E, 0x16, 0xD2, 0xFC,  // Service Data: len=0x1E, type=0x16, UUID=0xFCD2 (D2 FC)
+    0x40,  // Device Info: 0x40 = BTHome v2, unencrypted, regular interval
+    0x00, 0x00,  // 0x00 packet id
+    0x02, 0x00, 0x00,  // 0x02 temperature (0.01°C, little-endian)
+    0x03, 0x00, 0x00,  // 0x03 humidity (0.01%, little-endian)
+    0x2E, 0x00,  // 0x2E humidity min (1%)
+    0x2E, 0x00,  // 0x2E humidity max (1%)
+    0x2E, 0x00,  // 0x2E humidity mean (1%)
+    0x3D, 0x00, 0x00,  // 0x3D window sequence number and index (little-endian)
+    0x45, 0x00, 0x00,  // 0x45 temperature min (0.1°C, little-endian)
+    0x45, 0x00, 0x00,  // 0x45 temperature max (0.1°C, little-endian)
+    0x45, 0x00, 0x00,  // 0x45 temperature mean (0.1°C, little-endian)
+};
+
 uint8_t mac_public[6];
 
 _attribute_ram_code_ void user_set_rf_power (uint8_t e, uint8_t *p, int n)
@@ -85,3 +117,28 @@ void set_adv_data(int16_t temp, uint16_t humi, uint8_t battery_level, uint16_t b
 
     bls_ll_setAdvData((uint8_t *)advertising_data_BTHome, sizeof(advertising_data_BTHome));
 }
+
+void set_stats_adv_data(int16_t temp, uint16_t humi, uint8_t window, const stats_t *stats){
+    uint16_t humi_0_01 = humi * 100;
+    int16_t temp_0_01 = temp * 10;
+    uint16_t seq = (stats->seq << 1) | (window & 0x01);
+    // Packet id is shared with the regular ADV so gateways can deduplicate both
+    advertising_data_BTHome_stats[6] = ++advertising_data_BTHome[9];
+    advertising_data_BTHome_stats[8] = (uint8_t)(temp_0_01 & 0xFF);
+    advertising_data_BTHome_stats[9] = (uint8_t)((temp_0_01 >> 8) & 0xFF);
+    advertising_data_BTHome_stats[11] = (uint8_t)(humi_0_01 & 0xFF);
+    advertising_data_BTHome_stats[12] = (uint8_t)((humi_0_01 >> 8) & 0xFF);
+    advertising_data_BTHome_stats[14] = (uint8_t)stats->humi_min;
+    advertising_data_BTHome_stats[16] = (uint8_t)stats->humi_max;
+    advertising_data_BTHome_stats[18] = (uint8_t)stats->humi_mean;
+    advertising_data_BTHome_stats[20] = (uint8_t)(seq & 0xFF);
+    advertising_data_BTHome_stats[21] = (uint8_t)((seq >> 8) & 0xFF);
+    advertising_data_BTHome_stats[23] = (uint8_t)(stats->temp_min & 0xFF);
+    advertising_data_BTHome_stats[24] = (uint8_t)((stats->temp_min >> 8) & 0xFF);
+    advertising_data_BTHome_stats[26] = (uint8_t)(stats->temp_max & 0xFF);
+    advertising_data_BTHome_stats[27] = (uint8_t)((stats->temp_max >> 8) & 0xFF);
+    advertising_data_BTHome_stats[29] = (uint8_t)(stats->temp_mean & 0xFF);
+    advertising_data_BTHome_stats[30] = (uint8_t)((stats->temp_mean >> 8) & 0xFF);
+
+    bls_ll_setAdvData((uint8_t *)advertising_data_BTHome_stats, sizeof(advertising_data_BTHome_stats));
+}
@@ -3,6 +3,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "stats.h"
+
 void init_ble();
 void set_adv_data(int16_t temp, uint16_t humi, uint8_t battery_level, uint16_t battery_mv);
+void set_stats_adv_data(int16_t temp, uint16_t humi, uint8_t window, const stats_t *stats);
 void blt_pm_proc(void);
@@ -5,11 +5,19 @@
 #include "app_config.h"
 #include "drivers/8258/gpio_8258.h"
 
+#include "i2c.h"
+
 RAM bool i2c_sending;
 
 void init_i2c(){
     i2c_gpio_set(I2C_GPIO_GROUP_C2C3);
-    i2c_master_init(0x78, (uint8_t)(CLOCK_SYS_CLOCK_HZ/(4*600000)));
+    set_i2c_clock(CLOCK_SYS_CLOCK_HZ);
+}
+
+// I2C bus clock is derived from the system clock, so the divisor has to be
+// recomputed whenever the system clock changes
+void set_i2c_clock(uint32_t sys_clock_hz){
+    i2c_master_init(0x78, (uint8_t)(sys_clock_hz/(4*600000)));
 }
 
 void send_i2c(uint8_t device_id, uint8_t *buffer, int dataLen){
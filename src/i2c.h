@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 void init_i2c();
+void set_i2c_clock(uint32_t sys_clock_hz);
 void send_i2c(uint8_t device_id, uint8_t *buffer, int dataLen);
 uint8_t test_i2c_device(uint8_t address);
 
@@ -11,6 +11,10 @@
 
 #define pm_wait_ms(t) cpu_stall_wakeup_by_timer0(t*CLOCK_SYS_CLOCK_1MS);
 
+// B1.6 LCD controller UART baud rate; the divisor follows the system clock
+#define LCD_UART_BAUD 38400
+#define LCD_UART_BWPC 9
+
 const uint8_t lcd_init_cmd[] = {
     0x80, 0x3B, 0x80, 0x02, 0x80, 0x0F, 0x80, 0x95,
     0x80, 0x88, 0x80, 0x88, 0x80, 0x88, 0x80, 0x88,
@@ -77,13 +81,21 @@ void init_lcd_deepsleep(){
 
     uart_gpio_set(UART_TX_PD7, UART_RX_PB0);
     uart_reset();
-    uart_init(61,  9, PARITY_NONE, STOP_BIT_ONE);
+    set_lcd_uart_clock(CLOCK_SYS_CLOCK_HZ);
     uart_dma_enable(0, 0);
     dma_chn_irq_enable(0, 0);
     uart_irq_enable(0, 0);
     uart_ndma_irq_triglevel(0, 0);
 }
 
+void set_lcd_uart_clock(uint32_t sys_clock_hz){
+    if (lcd_version != 1)
+        return;
+
+    uint16_t clk_div = sys_clock_hz/(LCD_UART_BAUD*(LCD_UART_BWPC+1)) - 1;
+    uart_init(clk_div, LCD_UART_BWPC, PARITY_NONE, STOP_BIT_ONE);
+}
+
 void uart_send_lcd(uint8_t byte1, uint8_t byte2, uint8_t byte3, uint8_t byte4, uint8_t byte5, uint8_t byte6){
     uint8_t trans_buff[13] = {
         0x00, 0x00, 0x00, 0x00, 0xAA,
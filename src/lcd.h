@@ -5,6 +5,7 @@
 
 void init_lcd();
 void init_lcd_deepsleep();
+void set_lcd_uart_clock(uint32_t sys_clock_hz);
 void send_to_lcd(uint8_t byte1, uint8_t byte2, uint8_t byte3, uint8_t byte4, uint8_t byte5, uint8_t byte6);
 void update_lcd();
 void show_temp_symbol(uint8_t symbol);
@@ -5,6 +5,7 @@
 #include "vendor/common/user_config.h"
 
 #include "i2c.h"
+#include "sysclk.h"
 
 extern void user_init_normal();
 extern void user_init_deepRetn();
@@ -23,11 +24,7 @@ _attribute_ram_code_ int main(void)
     rf_drv_init(RF_MODE_BLE_1M);
     gpio_init(!deepRetWakeUp);
 
-#if (CLOCK_SYS_CLOCK_HZ == 16000000)
-    clock_init(SYS_CLK_16M_Crystal);
-#elif (CLOCK_SYS_CLOCK_HZ == 24000000)
-    clock_init(SYS_CLK_24M_Crystal);
-#endif
+    clock_init(RADIO_SYS_CLK);
 
     blc_app_loadCustomizedParameters();
 
@@ -5,6 +5,8 @@ $(OUT_PATH)/ble.o \
 $(OUT_PATH)/i2c.o \
 $(OUT_PATH)/lcd.o \
 $(OUT_PATH)/sensor.o \
+$(OUT_PATH)/stats.o \
+$(OUT_PATH)/sysclk.o \
 $(OUT_PATH)/main.o
 
 
@@ -30,6 +30,19 @@
 #define CONF_TEMP_OFFSET 0
 #define CONF_HUMI_OFFSET 0
 
+// Statistics window lengths in minutes - sensor measurements taken within
+// each window are aggregated into one min/max/mean. Both windows run side by
+// side. A window closes on the first measurement after its time is up.
+#define CONF_STATS_WINDOW_SHORT_MINUTES 60
+#define CONF_STATS_WINDOW_LONG_MINUTES 1440
+
+// Statistics advertisement interval - every N measurements the BTHome payload
+// carries the current reading plus the min/max/mean of the last completed
+// window (instead of battery data) until the next measurement. The two
+// windows take turns.
+// 0 - Do not advertise statistics
+#define CONF_STATS_ADV_MEASUREMENTS 4
+
 // BLE advertisement interval as given to the Telink BLE stack
 #define CONF_ADV_INTERVAL 10000
 
@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include "tl_common.h"
+#include "drivers.h"
+#include "vendor/common/user_config.h"
+#include "app_config.h"
+
+#include "settings.h"
+#include "stats.h"
+
+
+typedef struct {
+    int16_t temp_min;
+    int16_t temp_max;
+    int32_t temp_sum;
+    uint16_t humi_min;
+    uint16_t humi_max;
+    uint32_t humi_sum;
+    uint16_t count;
+} stats_acc_t;
+
+const uint32_t stats_window_ms[STATS_WINDOWS] = {
+    CONF_STATS_WINDOW_SHORT_MINUTES*60000,
+    CONF_STATS_WINDOW_LONG_MINUTES*60000,
+};
+
+// Tumbling min/max/sum windows over sensor measurements. Each measurement is
+// folded into every window in constant time; once a window's time is up it
+// is latched into stats_last and started over. How often main_loop() runs
+// depends on the ADV interval, so windows are timed on elapsed clock_time()
+// rather than on a measurement count. Everything lives in retention RAM so
+// the statistics survive deep sleep.
+RAM stats_acc_t stats_acc[STATS_WINDOWS];
+RAM uint32_t stats_elapsed_ms[STATS_WINDOWS];
+RAM uint32_t stats_last_tick;
+RAM stats_t stats_last[STATS_WINDOWS];
+RAM uint16_t stats_seq[STATS_WINDOWS];
+RAM bool stats_valid[STATS_WINDOWS];
+
+void init_stats(){
+    stats_last_tick = clock_time();
+}
+
+// Called on every main_loop() pass; clock_time() wraps every ~268s, so the
+// elapsed time has to be collected more often than measurements are taken
+void tick_stats(){
+    uint32_t elapsed_ms = (clock_time() - stats_last_tick) / CLOCK_16M_SYS_TIMER_CLK_1MS;
+    stats_last_tick += elapsed_ms * CLOCK_16M_SYS_TIMER_CLK_1MS;
+    for (uint8_t i = 0; i < STATS_WINDOWS; i++)
+        stats_elapsed_ms[i] += elapsed_ms;
+}
+
+void update_stats(int16_t temp, uint16_t humi){
+    for (uint8_t i = 0; i < STATS_WINDOWS; i++){
+        stats_acc_t *acc = &stats_acc[i];
+
+        if (acc->count == 0){
+            acc->temp_min = acc->temp_max = temp;
+            acc->humi_min = acc->humi_max = humi;
+            acc->temp_sum = 0;
+            acc->humi_sum = 0;
+        }
+
+        if (temp < acc->temp_min) acc->temp_min = temp;
+        if (temp > acc->temp_max) acc->temp_max = temp;
+        if (humi < acc->humi_min) acc->humi_min = humi;
+        if (humi > acc->humi_max) acc->humi_max = humi;
+        acc->temp_sum += temp;
+        acc->humi_sum += humi;
+        acc->count++;
+
+        if (stats_elapsed_ms[i] >= stats_window_ms[i]){
+            stats_last[i].seq = stats_seq[i]++;
+            stats_last[i].temp_min = acc->temp_min;
+            stats_last[i].temp_max = acc->temp_max;
+            stats_last[i].temp_mean = acc->temp_sum / acc->count;
+            stats_last[i].humi_min = acc->humi_min;
+            stats_last[i].humi_max = acc->humi_max;
+            stats_last[i].humi_mean = acc->humi_sum / acc->count;
+            stats_valid[i] = true;
+            acc->count = 0;
+            // Keep the window cadence, unless measurements stalled for longer
+            // than a whole window
+            stats_elapsed_ms[i] -= stats_window_ms[i];
+            if (stats_elapsed_ms[i] >= stats_window_ms[i])
+                stats_elapsed_ms[i] = 0;
+        }
+    }
+}
+
+// Returns the last completed window; false until the first one completes
+bool get_stats(uint8_t window, stats_t *stats){
+    if (window >= STATS_WINDOWS || !stats_valid[window])
+        return false;
+    *stats = stats_last[window];
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of statistics windows; lengths are set in settings.h
+#define STATS_WINDOWS 2
+
+typedef struct {
+    uint16_t seq;  // number of windows completed before this one
+    int16_t temp_min;
+    int16_t temp_max;
+    int16_t temp_mean;
+    uint16_t humi_min;
+    uint16_t humi_max;
+    uint16_t humi_mean;
+} stats_t;
+
+void init_stats();
+void tick_stats();
+void update_stats(int16_t temp, uint16_t humi);
+bool get_stats(uint8_t window, stats_t *stats);
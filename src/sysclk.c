@@ -0,0 +1,32 @@
+#include <stdint.h>
+#include "tl_common.h"
+#include "drivers.h"
+#include "vendor/common/user_config.h"
+#include "app_config.h"
+
+#include "i2c.h"
+#include "lcd.h"
+#include "sysclk.h"
+
+// Sensor, LCD and battery work is bound by the I2C/UART buses and the sensor
+// conversion time, so it runs just as well on a slower system clock. Only the
+// BLE stack needs CLOCK_SYS_CLOCK_HZ. clock_time() and sleep_us() run off the
+// 16MHz system timer and the ADC off the crystal, so neither is affected by
+// the switch; the I2C and UART dividers are.
+static void switch_sys_clock(SYS_CLK_TypeDef sys_clk, uint32_t sys_clock_hz){
+    clock_init(sys_clk);
+    set_i2c_clock(sys_clock_hz);
+    set_lcd_uart_clock(sys_clock_hz);
+}
+
+void set_housekeeping_clock(){
+#if (CLOCK_HOUSEKEEPING_HZ != CLOCK_SYS_CLOCK_HZ)
+    switch_sys_clock(HOUSEKEEPING_SYS_CLK, CLOCK_HOUSEKEEPING_HZ);
+#endif
+}
+
+void set_radio_clock(){
+#if (CLOCK_HOUSEKEEPING_HZ != CLOCK_SYS_CLOCK_HZ)
+    switch_sys_clock(RADIO_SYS_CLK, CLOCK_SYS_CLOCK_HZ);
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "app_config.h"
+
+#if (CLOCK_SYS_CLOCK_HZ == 16000000)
+#define RADIO_SYS_CLK SYS_CLK_16M_Crystal
+#elif (CLOCK_SYS_CLOCK_HZ == 24000000)
+#define RADIO_SYS_CLK SYS_CLK_24M_Crystal
+#else
+#error "Unsupported CLOCK_SYS_CLOCK_HZ"
+#endif
+
+#if (CLOCK_HOUSEKEEPING_HZ == 12000000)
+#define HOUSEKEEPING_SYS_CLK SYS_CLK_12M_Crystal
+#elif (CLOCK_HOUSEKEEPING_HZ == 16000000)
+#define HOUSEKEEPING_SYS_CLK SYS_CLK_16M_Crystal
+#elif (CLOCK_HOUSEKEEPING_HZ == 24000000)
+#define HOUSEKEEPING_SYS_CLK SYS_CLK_24M_Crystal
+#else
+#error "Unsupported CLOCK_HOUSEKEEPING_HZ"
+#endif
+
+void set_housekeeping_clock();
+void set_radio_clock();